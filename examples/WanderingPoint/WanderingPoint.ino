@@ -18,14 +18,14 @@ bool md[] = {
 const int iNumMatrixRows = 4;
 const int iNumMatrixColumns = 1;
 
-LedMatrix lm = LedMatrix(12, //Data pin
-                         11, //CLK pin
-                         10, //CS pin
-                         0,  //intiensity
-                         mc, //matrix configuration
-                         md, //matrix directions (are the matrices rotated by 180°)
-                         iNumMatrixRows, //the number of rows
-                         iNumMatrixColumns); //the number of columns
+LedMatrix lm(12, //Data pin
+             11, //CLK pin
+             10, //CS pin
+             0,  //intiensity
+             mc, //matrix configuration
+             md, //matrix directions (are the matrices rotated by 180°)
+             iNumMatrixRows, //the number of rows
+             iNumMatrixColumns); //the number of columns
 
 
 void setup()
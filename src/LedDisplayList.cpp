@@ -0,0 +1,305 @@
+//include the header file
+#include "LedDisplayList.h"
+
+//the class constructor
+LedDisplayList::LedDisplayList(LedMatrix* pMatrix, DisplayItem* pItems, int iMaxItems)
+{
+	m_pMatrix = pMatrix;
+	m_Items = pItems;
+	m_iMaxItems = iMaxItems;
+
+	//every item is unused at the beginning
+	for (int i = 0; i < m_iMaxItems; i++)
+		m_Items[i].iType = DISPLAY_ITEM_NONE;
+
+	m_iNumDirtyAreas = 0;
+}
+
+
+
+//private functions
+//get the handle of an unused item
+int LedDisplayList::GetFreeItem()
+{
+	for (int i = 0; i < m_iMaxItems; i++)
+	{
+		if (m_Items[i].iType == DISPLAY_ITEM_NONE)
+			return i;
+	}
+
+	return -1;
+}
+
+//get the area, which is covered by an item
+void LedDisplayList::GetItemArea(int iHandle, int* pArea)
+{
+	DisplayItem& CurrItem = m_Items[iHandle];
+
+	if (CurrItem.iType == DISPLAY_ITEM_BITMAP)
+	{
+		//a bitmap covers "width" bytes with 8 LEDs each
+		pArea[0] = CurrItem.iCoords[0];
+		pArea[1] = CurrItem.iCoords[1];
+		pArea[2] = CurrItem.iCoords[0] + 8 * CurrItem.iCoords[2] - 1;
+		pArea[3] = CurrItem.iCoords[1] + CurrItem.iCoords[3] - 1;
+	}
+	else
+	{
+		//lines and rectangles are stored by two of their corners
+		pArea[0] = min(CurrItem.iCoords[0], CurrItem.iCoords[2]);
+		pArea[1] = min(CurrItem.iCoords[1], CurrItem.iCoords[3]);
+		pArea[2] = max(CurrItem.iCoords[0], CurrItem.iCoords[2]);
+		pArea[3] = max(CurrItem.iCoords[1], CurrItem.iCoords[3]);
+	}
+}
+
+//mark an area to be redrawn
+void LedDisplayList::AddDirtyArea(const int* pArea)
+{
+	//if the area touches an other one, just enlarge that one
+	int iMergeArea = -1;
+	for (int i = 0; i < m_iNumDirtyAreas; i++)
+	{
+		if ((pArea[0] <= m_DirtyAreas[i][2] + 1) && (m_DirtyAreas[i][0] <= pArea[2] + 1) &&
+			(pArea[1] <= m_DirtyAreas[i][3] + 1) && (m_DirtyAreas[i][1] <= pArea[3] + 1))
+		{
+			iMergeArea = i;
+			break;
+		}
+	}
+
+	//otherwise use a new area, as long as there are some left
+	if ((iMergeArea < 0) && (m_iNumDirtyAreas < LED_DISPLAY_LIST_MAX_AREAS))
+	{
+		for (int i = 0; i < 4; i++)
+			m_DirtyAreas[m_iNumDirtyAreas][i] = pArea[i];
+		m_iNumDirtyAreas++;
+		return;
+	}
+
+	//if there aren't any areas left, enlarge the one, which grows the least
+	if (iMergeArea < 0)
+	{
+		long lMinSize = 0;
+		for (int i = 0; i < m_iNumDirtyAreas; i++)
+		{
+			long lSize = (long)(max(pArea[2], m_DirtyAreas[i][2]) - min(pArea[0], m_DirtyAreas[i][0]) + 1) *
+				(max(pArea[3], m_DirtyAreas[i][3]) - min(pArea[1], m_DirtyAreas[i][1]) + 1);
+			if ((iMergeArea < 0) || (lSize < lMinSize))
+			{
+				iMergeArea = i;
+				lMinSize = lSize;
+			}
+		}
+	}
+
+	m_DirtyAreas[iMergeArea][0] = min(m_DirtyAreas[iMergeArea][0], pArea[0]);
+	m_DirtyAreas[iMergeArea][1] = min(m_DirtyAreas[iMergeArea][1], pArea[1]);
+	m_DirtyAreas[iMergeArea][2] = max(m_DirtyAreas[iMergeArea][2], pArea[2]);
+	m_DirtyAreas[iMergeArea][3] = max(m_DirtyAreas[iMergeArea][3], pArea[3]);
+}
+
+//mark the area of an item to be redrawn
+void LedDisplayList::SetItemDirty(int iHandle)
+{
+	//an item, which isn't displayed, doesn't change anything
+	if ((m_Items[iHandle].iType == DISPLAY_ITEM_NONE) || !m_Items[iHandle].bVisible)
+		return;
+
+	int Area[4];
+	GetItemArea(iHandle, Area);
+	AddDirtyArea(Area);
+}
+
+//draw one item on the matrix
+void LedDisplayList::DrawItem(int iHandle)
+{
+	DisplayItem& CurrItem = m_Items[iHandle];
+
+	if (CurrItem.iType == DISPLAY_ITEM_LINE)
+		m_pMatrix->DrawLine(CurrItem.iCoords[0], CurrItem.iCoords[1], CurrItem.iCoords[2], CurrItem.iCoords[3]);
+	else if (CurrItem.iType == DISPLAY_ITEM_RECTANGLE)
+		m_pMatrix->DrawRectangle(CurrItem.iCoords[0], CurrItem.iCoords[1], CurrItem.iCoords[2], CurrItem.iCoords[3], CurrItem.bFill);
+	else if (CurrItem.iType == DISPLAY_ITEM_BITMAP)
+		m_pMatrix->DrawBitmap(CurrItem.iCoords[0], CurrItem.iCoords[1], CurrItem.pStates, CurrItem.iCoords[2], CurrItem.iCoords[3]);
+}
+
+
+
+//public functions
+//add an item to the list
+//add a line
+int LedDisplayList::AddLine(int iStartX, int iStartY, int iEndX, int iEndY)
+{
+	int iHandle = GetFreeItem();
+	if (iHandle < 0)
+		return -1;
+
+	//the item stays hidden until it is set up, so it doesn't mark any area dirty before it has one
+	m_Items[iHandle].iType = DISPLAY_ITEM_LINE;
+	m_Items[iHandle].bVisible = false;
+	SetLine(iHandle, iStartX, iStartY, iEndX, iEndY);
+	SetVisible(iHandle, true);
+
+	return iHandle;
+}
+
+//add a rectangle
+int LedDisplayList::AddRectangle(int iLeft, int iTop, int iRight, int iBottom, bool bFill)
+{
+	int iHandle = GetFreeItem();
+	if (iHandle < 0)
+		return -1;
+
+	//the item stays hidden until it is set up, so it doesn't mark any area dirty before it has one
+	m_Items[iHandle].iType = DISPLAY_ITEM_RECTANGLE;
+	m_Items[iHandle].bVisible = false;
+	SetRectangle(iHandle, iLeft, iTop, iRight, iBottom, bFill);
+	SetVisible(iHandle, true);
+
+	return iHandle;
+}
+
+//add a bitmap
+int LedDisplayList::AddBitmap(int iLeft, int iTop, const char* pStates, int iWidth, int iHeight)
+{
+	int iHandle = GetFreeItem();
+	if (iHandle < 0)
+		return -1;
+
+	//the item stays hidden until it is set up, so it doesn't mark any area dirty before it has one
+	m_Items[iHandle].iType = DISPLAY_ITEM_BITMAP;
+	m_Items[iHandle].bVisible = false;
+	SetBitmap(iHandle, iLeft, iTop, pStates, iWidth, iHeight);
+	SetVisible(iHandle, true);
+
+	return iHandle;
+}
+
+//change a line
+void LedDisplayList::SetLine(int iHandle, int iStartX, int iStartY, int iEndX, int iEndY)
+{
+	if ((iHandle < 0) || (iHandle >= m_iMaxItems) || (m_Items[iHandle].iType != DISPLAY_ITEM_LINE))
+		return;
+
+	//both the old and the new area of the item have to be redrawn
+	SetItemDirty(iHandle);
+	m_Items[iHandle].iCoords[0] = iStartX;
+	m_Items[iHandle].iCoords[1] = iStartY;
+	m_Items[iHandle].iCoords[2] = iEndX;
+	m_Items[iHandle].iCoords[3] = iEndY;
+	SetItemDirty(iHandle);
+}
+
+//change a rectangle
+void LedDisplayList::SetRectangle(int iHandle, int iLeft, int iTop, int iRight, int iBottom, bool bFill)
+{
+	if ((iHandle < 0) || (iHandle >= m_iMaxItems) || (m_Items[iHandle].iType != DISPLAY_ITEM_RECTANGLE))
+		return;
+
+	//both the old and the new area of the item have to be redrawn
+	SetItemDirty(iHandle);
+	m_Items[iHandle].iCoords[0] = iLeft;
+	m_Items[iHandle].iCoords[1] = iTop;
+	m_Items[iHandle].iCoords[2] = iRight;
+	m_Items[iHandle].iCoords[3] = iBottom;
+	m_Items[iHandle].bFill = bFill;
+	SetItemDirty(iHandle);
+}
+
+//change a bitmap
+void LedDisplayList::SetBitmap(int iHandle, int iLeft, int iTop, const char* pStates, int iWidth, int iHeight)
+{
+	if ((iHandle < 0) || (iHandle >= m_iMaxItems) || (m_Items[iHandle].iType != DISPLAY_ITEM_BITMAP))
+		return;
+
+	//both the old and the new area of the item have to be redrawn
+	SetItemDirty(iHandle);
+	m_Items[iHandle].iCoords[0] = iLeft;
+	m_Items[iHandle].iCoords[1] = iTop;
+	m_Items[iHandle].iCoords[2] = iWidth;
+	m_Items[iHandle].iCoords[3] = iHeight;
+	m_Items[iHandle].pStates = pStates;
+	SetItemDirty(iHandle);
+}
+
+//show or hide an item
+void LedDisplayList::SetVisible(int iHandle, bool bVisible)
+{
+	if ((iHandle < 0) || (iHandle >= m_iMaxItems) || (m_Items[iHandle].bVisible == bVisible))
+		return;
+
+	//mark the item dirty while it is visible
+	SetItemDirty(iHandle);
+	m_Items[iHandle].bVisible = bVisible;
+	SetItemDirty(iHandle);
+}
+
+//remove an item from the list
+void LedDisplayList::Remove(int iHandle)
+{
+	if ((iHandle < 0) || (iHandle >= m_iMaxItems))
+		return;
+
+	SetItemDirty(iHandle);
+	m_Items[iHandle].iType = DISPLAY_ITEM_NONE;
+}
+
+//tell the display list, that the content of a bitmap was changed
+void LedDisplayList::ItemChanged(int iHandle)
+{
+	if ((iHandle < 0) || (iHandle >= m_iMaxItems))
+		return;
+
+	SetItemDirty(iHandle);
+}
+
+
+//draw the changes on the matrix
+void LedDisplayList::Render()
+{
+	if (m_iNumDirtyAreas == 0)
+		return;
+
+	//repeat for each area, which has to be redrawn
+	for (int i = 0; i < m_iNumDirtyAreas; i++)
+	{
+		const int* pDirtyArea = m_DirtyAreas[i];
+
+		//only the LEDs in the area are changed, so the LED rows outside of it don't have to be sent again
+		m_pMatrix->SetClipArea(pDirtyArea[0], pDirtyArea[1], pDirtyArea[2], pDirtyArea[3]);
+		m_pMatrix->ClearArea(pDirtyArea[0], pDirtyArea[1], pDirtyArea[2], pDirtyArea[3]);
+
+		//redraw every item, which covers the area
+		for (int j = 0; j < m_iMaxItems; j++)
+		{
+			if ((m_Items[j].iType == DISPLAY_ITEM_NONE) || !m_Items[j].bVisible)
+				continue;
+
+			int Area[4];
+			GetItemArea(j, Area);
+			if ((Area[0] <= pDirtyArea[2]) && (pDirtyArea[0] <= Area[2]) &&
+				(Area[1] <= pDirtyArea[3]) && (pDirtyArea[1] <= Area[3]))
+				DrawItem(j);
+		}
+	}
+
+	//every area is up to date now
+	m_pMatrix->ResetClipArea();
+	m_iNumDirtyAreas = 0;
+}
+
+//clear the whole display and draw every item
+void LedDisplayList::RenderAll()
+{
+	m_pMatrix->ResetClipArea();
+	m_pMatrix->ClearDisplay();
+
+	for (int i = 0; i < m_iMaxItems; i++)
+	{
+		if ((m_Items[i].iType != DISPLAY_ITEM_NONE) && m_Items[i].bVisible)
+			DrawItem(i);
+	}
+
+	m_iNumDirtyAreas = 0;
+}
@@ -0,0 +1,129 @@
+//make sure the code is executed only once
+#ifndef LED_DISPLAY_LIST_H
+#define LED_DISPLAY_LIST_H
+
+//include the LedMatrix library, which draws the items
+#include "LedMatrix.h"
+
+
+
+//constants
+//the types of the items in a display list
+const int DISPLAY_ITEM_NONE			= 0; //the item isn't used
+const int DISPLAY_ITEM_LINE			= 1;
+const int DISPLAY_ITEM_RECTANGLE	= 2;
+const int DISPLAY_ITEM_BITMAP		= 3;
+
+//the maximum number of areas, which are redrawn separately (if more areas change, they are merged)
+const int LED_DISPLAY_LIST_MAX_AREAS	= 4;
+
+
+
+//one item of a display list
+struct DisplayItem
+{
+	int iType; //one of the DISPLAY_ITEM_... constants
+	bool bVisible;
+	bool bFill; //only used by rectangles
+	int iCoords[4]; //line: start x, start y, end x, end y; rectangle: left, top, right, bottom; bitmap: left, top, width (in bytes), height
+	const char* pStates; //only used by bitmaps
+};
+
+
+
+//the LedDisplayList class
+class LedDisplayList
+{
+private: //private class members
+
+	//the matrix, the items are drawn on
+	LedMatrix* m_pMatrix;
+
+	//the items
+	DisplayItem* m_Items;
+	int m_iMaxItems;
+
+	//the areas, which have to be redrawn (left, top, right, bottom)
+	int m_DirtyAreas[LED_DISPLAY_LIST_MAX_AREAS][4];
+	int m_iNumDirtyAreas;
+
+
+	//helper functions
+	//get the handle of an unused item (returns -1 if every item is used)
+	int GetFreeItem();
+
+	//get the area, which is covered by an item
+	void GetItemArea(int iHandle, int* pArea);
+
+	//mark an area to be redrawn
+	void AddDirtyArea(const int* pArea);
+
+	//mark the area of an item to be redrawn, if it is visible
+	void SetItemDirty(int iHandle);
+
+	//draw one item on the matrix
+	void DrawItem(int iHandle);
+
+
+public: //public class members
+
+	//constructor
+	LedDisplayList(LedMatrix* pMatrix, //the matrix, the items are drawn on
+		DisplayItem* pItems, //the memory for the items (it has to stay valid as long as the display list is used)
+		int iMaxItems); //how much items fit into "pItems"
+
+	/*
+	a display list remembers what is drawn on the matrix, so only the areas which changed have to be redrawn
+
+	e.g.
+	DisplayItem Items[8];
+	LedDisplayList dl = LedDisplayList(&lm, Items, 8);
+
+	int iFrame = dl.AddRectangle(0, 0, 31, 15, false);
+	int iNeedle = dl.AddLine(16, 8, 16, 1);
+	dl.Render();
+
+	dl.SetLine(iNeedle, 16, 8, 22, 3); //only the area around the old and the new needle gets redrawn
+	dl.Render();
+	lm.UpdateMatrix();
+
+	the display list takes over the whole display of the matrix: "Render" clears the changed areas,
+	so LEDs which were set directly (e.g. with "SetLed") disappear as soon as an item changes around them,
+	and the clip area of the matrix is reset after every call
+	*/
+
+
+	//add an item to the list
+	//each function returns the handle of the new item or -1, if the list is full
+	//add a line
+	int AddLine(int iStartX, int iStartY, int iEndX, int iEndY);
+	//add a rectangle
+	int AddRectangle(int iLeft, int iTop, int iRight, int iBottom, bool bFill);
+	//add a bitmap ("pStates" is stored like in "SetDisplay" and has to stay valid as long as the item is used)
+	int AddBitmap(int iLeft, int iTop, const char* pStates, int iWidth, int iHeight);
+
+	//change an item of the list
+	void SetLine(int iHandle, int iStartX, int iStartY, int iEndX, int iEndY);
+	void SetRectangle(int iHandle, int iLeft, int iTop, int iRight, int iBottom, bool bFill);
+	void SetBitmap(int iHandle, int iLeft, int iTop, const char* pStates, int iWidth, int iHeight);
+
+	//show or hide an item
+	void SetVisible(int iHandle, bool bVisible);
+
+	//remove an item from the list (the handle can be reused by the next item which is added)
+	void Remove(int iHandle);
+
+	//tell the display list, that the content of a bitmap was changed
+	void ItemChanged(int iHandle);
+
+
+	//draw the changes on the matrix
+	//only the areas of the items, which were changed since the last call, are cleared and redrawn (nothing outside of them is changed)
+	void Render();
+
+	//clear the whole display and draw every item
+	void RenderAll();
+};
+
+
+#endif //LED_DISPLAY_LIST_H
@@ -1,9 +1,91 @@
-//include the header file
+//include the header files
 #include "LedMatrix.h"
+#include "LedMatrixBus.h"
 
-//the class constructor
+//the class constructors
 LedMatrix::LedMatrix(int iDataPin, int iClkPin, int iCSPin, int iLEDIntensity,
 	int* MatrixConfig, bool* bSwitchedDir, int iMatrixNumColumns, int iMatrixNumRows)
+{
+	Setup(iDataPin, iClkPin, iCSPin, MatrixConfig, bSwitchedDir, iMatrixNumColumns, iMatrixNumRows);
+
+	//the chain isn't connected to a bus, so it has to initialize its matrices itself
+	m_pBus = 0;
+	InitMatrices(iLEDIntensity);
+}
+
+LedMatrix::LedMatrix(LedMatrixBus* pBus, int iCSPin, int* MatrixConfig, bool* bSwitchedDir, int iMatrixNumColumns, int iMatrixNumRows, int iLEDIntensity)
+{
+	Setup(pBus->m_iDataPin, pBus->m_iClkPin, iCSPin, MatrixConfig, bSwitchedDir, iMatrixNumColumns, iMatrixNumRows);
+
+	//the matrices are initialized by the bus together with the other chains
+	m_pBus = pBus;
+	if (!pBus->AddMatrix(this))
+	{
+		//the bus is full, so the chain has to be initialized and updated on its own
+		m_pBus = 0;
+		InitMatrices(iLEDIntensity);
+	}
+}
+
+//the class destructor
+LedMatrix::~LedMatrix()
+{
+	//the bus mustn't send any data to this chain anymore
+	if (m_pBus != 0)
+		m_pBus->RemoveMatrix(this);
+
+	//prepare the controllers for receiving data
+	*m_pCSPinReg &= NotTwoToThe[m_iCSPinNum];
+	for (int i = 0; i < m_iNumMatrices; i++)
+	{
+		//go back into shutdown mode
+		SendData(12, 0);
+	}
+	//latch the data into the controllers
+	*m_pCSPinReg |= TwoToThe[m_iCSPinNum];
+
+	delete[] m_LedState;
+	delete[] m_MatrixBase;
+	delete[] m_ControllerMatrix;
+	delete[] m_DisplayMap;
+	delete[] m_ClipStates;
+}
+
+//is the chain updated by a bus
+bool LedMatrix::IsOnBus()
+{
+	return m_pBus != 0;
+}
+
+
+
+//private functions
+//calculate where each byte of "SetDisplay" is stored in m_LedState
+void LedMatrix::BuildDisplayMap()
+{
+	m_DisplayMap = new int[8 * m_iNumMatrices];
+
+	//repeat for each matrix
+	for (int i = 0; i < m_iNumMatrices; i++)
+	{
+		//the position of the first byte of the matrix in "SetDisplay"
+		int iStatesNum = (i % m_iColumns) + 8 * m_iColumns * (i / m_iColumns);
+
+		//repeat for each row
+		for (int j = 0; j < 8; j++)
+		{
+			/*the rows of a turned matrix are stored from the bottom to the top,
+			the bits of a matrix, which isn't turned, are stored in reversed order (marked by storing the index inverted)*/
+			if (m_MatrixDirSwitched[i])
+				m_DisplayMap[iStatesNum + j * m_iColumns] = m_MatrixBase[i] - j * m_iNumMatrices;
+			else
+				m_DisplayMap[iStatesNum + j * m_iColumns] = ~(m_MatrixBase[i] + j * m_iNumMatrices);
+		}
+	}
+}
+
+//set up the class members and the pins
+void LedMatrix::Setup(int iDataPin, int iClkPin, int iCSPin, int* MatrixConfig, bool* bSwitchedDir, int iMatrixNumColumns, int iMatrixNumRows)
 {
 	//set the number of rows and columns
 	m_iColumns = iMatrixNumColumns;
@@ -21,6 +103,42 @@ LedMatrix::LedMatrix(int iDataPin, int iClkPin, int iCSPin, int iLEDIntensity,
 	for (int i = 0; i < 8 * m_iNumMatrices; i++)
 		m_LedState[i] = 0;
 
+	//precalculate the index of the first LED row of each matrix, so it doesn't have to be re-calculated for each LED
+	m_MatrixBase = new int[m_iNumMatrices];
+	for (int i = 0; i < m_iNumMatrices; i++)
+	{
+		//the rows of a turned matrix are stored from the bottom to the top
+		m_MatrixBase[i] = (m_iNumMatrices - 1 - m_MatrixConfig[i]) + (m_MatrixDirSwitched[i] ? 7 * m_iNumMatrices : 0);
+	}
+
+	//store which matrix is displayed by which controller, so the layers can be found while updating the matrix
+	m_ControllerMatrix = new int[m_iNumMatrices];
+	m_bAnyDirSwitched = false;
+	for (int i = 0; i < m_iNumMatrices; i++)
+	{
+		m_ControllerMatrix[m_iNumMatrices - 1 - m_MatrixConfig[i]] = i;
+		if (m_MatrixDirSwitched[i])
+			m_bAnyDirSwitched = true;
+	}
+
+	//the position of each byte of "SetDisplay" is calculated when it is used the first time
+	m_DisplayMap = 0;
+
+	//every LED row has to be sent in the first update
+	m_iDirtyRows = 0b11111111;
+
+	//the drawing commands can change the whole display
+	m_ClipStates = 0;
+	m_bClipStatesValid = false;
+	ResetClipArea();
+
+	//there aren't any layers yet
+	for (int i = 0; i < LED_MATRIX_MAX_LAYERS; i++)
+	{
+		m_Layers[i].pStates = 0;
+		m_Layers[i].bVisible = false;
+	}
+
 	//the pin registers
 	m_pMOSIPinReg = (iDataPin >= 8) ? (int*)&PORTB : (int*)&PORTD;
 	m_pCLKPinReg = (iClkPin >= 8) ? (int*)&PORTB : (int*)&PORTD;
@@ -35,8 +153,13 @@ LedMatrix::LedMatrix(int iDataPin, int iClkPin, int iCSPin, int iLEDIntensity,
 	pinMode(iClkPin, OUTPUT);
 	pinMode(iCSPin, OUTPUT);
 
+	//the controllers only receive data while the CS pin is low
+	*m_pCSPinReg |= TwoToThe[m_iCSPinNum];
+}
 
-	//initialize the matrices
+//initialize the matrices of this chain
+void LedMatrix::InitMatrices(int iLEDIntensity)
+{
 	//repeat every command for each matrix and latch it into the controllers registers afterwards
 	//prepare the controllers for receiving data
 	*m_pCSPinReg &= NotTwoToThe[m_iCSPinNum];
@@ -89,25 +212,6 @@ LedMatrix::LedMatrix(int iDataPin, int iClkPin, int iCSPin, int iLEDIntensity,
 	*m_pCSPinReg |= TwoToThe[m_iCSPinNum];
 }
 
-//the class destructor
-LedMatrix::~LedMatrix()
-{
-	//prepare the controllers for receiving data
-	*m_pCSPinReg &= NotTwoToThe[m_iCSPinNum];
-	for (int i = 0; i < m_iNumMatrices; i++)
-	{
-		//go back into shutdown mode
-		SendData(12, 0);
-	}
-	//latch the data into the controllers
-	*m_pCSPinReg |= TwoToThe[m_iCSPinNum];
-
-	delete[] m_LedState;
-}
-
-
-
-//private functions
 //send any data to the matrix
 void LedMatrix::SendData(int iAddress, int iData)
 {
@@ -172,8 +276,8 @@ void LedMatrix::SendData(int iAddress, int iData)
 }
 
 
-//send 8 values from m_LedState to the matrix controller
-void LedMatrix::SendLEDStates(int* iMOSIPin, int* iNotMOSIPin, int* iCLKPin, int* iNotCLKPin, int iAddress, int iBegin) //todo: don't pass pin enablers and disablers as pointers
+//send 8 LED states to the matrix controller
+void LedMatrix::SendLEDStates(int* iMOSIPin, int* iNotMOSIPin, int* iCLKPin, int* iNotCLKPin, int iAddress, char iStates) //todo: don't pass pin enablers and disablers as pointers
 {
 	//the first four bits are ignored by the controller, so just clock through them
 	*m_pMOSIPinReg &= *iNotMOSIPin;
@@ -219,8 +323,8 @@ void LedMatrix::SendLEDStates(int* iMOSIPin, int* iNotMOSIPin, int* iCLKPin, int
 		//set the clock pin to a low power state
 		*m_pCLKPinReg &= *iNotCLKPin;
 
-		//send one bit, either 0 or 1, depending on the value in "m_LedState"
-		if (m_LedState[iBegin] & TwoToThe[i])
+		//send one bit, either 0 or 1, depending on the value in "iStates"
+		if (iStates & TwoToThe[i])
 		{
 			//if bit "i" in "iData" is 1, set the data pin to HIGH...
 			*m_pMOSIPinReg |= *iMOSIPin;
@@ -237,6 +341,330 @@ void LedMatrix::SendLEDStates(int* iMOSIPin, int* iNotMOSIPin, int* iCLKPin, int
 }
 
 
+//send one LED row to every matrix controller
+void LedMatrix::SendRow(int* iMOSIPin, int* iNotMOSIPin, int* iCLKPin, int* iNotCLKPin, int iRow, bool bBlendLayers)
+{
+	int iTotalColumns = m_iNumMatrices;
+
+	//set the CS pin to low, so we can send data to the matrix controller
+	*m_pCSPinReg &= NotTwoToThe[m_iCSPinNum];
+
+	//repeat it for each matrix
+	for (int j = 0; j < iTotalColumns; j++)
+	{
+		//send the LED states to the matrix controller
+		if (bBlendLayers)
+			SendLEDStates(iMOSIPin, iNotMOSIPin, iCLKPin, iNotCLKPin, iRow + 1, BlendLayers(iRow, j));
+		else
+			SendLEDStates(iMOSIPin, iNotMOSIPin, iCLKPin, iNotCLKPin, iRow + 1, m_LedState[j + iTotalColumns * iRow]);
+	}
+
+	/*set the CS pin to high, so the data get latched into the registers of the controller
+	and the LEDs get enabled*/
+	*m_pCSPinReg |= TwoToThe[m_iCSPinNum];
+}
+
+
+//find the index in m_LedState, the LED row and the bit of the LED at the given coordinates
+bool LedMatrix::LocatePixel(int iCoordX, int iCoordY, int& iLedStateNum, int& iRow, char& iBit)
+{
+	//skip every LED, which isn't in the clip area
+	if ((iCoordX < m_ClipArea[0]) || (iCoordX > m_ClipArea[2]) || (iCoordY < m_ClipArea[1]) || (iCoordY > m_ClipArea[3]))
+		return false;
+
+	//calculate the number of the matrix, the pixel gets displayed on
+	int iMatrixNum = (iCoordY >> 3) * m_iColumns + (iCoordX >> 3);
+
+	//calculate the position on the 8x8 matrix
+	int iLocalX = iCoordX & 7;
+	int iLocalY = iCoordY & 7;
+
+	/*the position of the matrix is already known, we just need to know whether the matrix,
+	where the point is displayed on is turned around by 180 or not*/
+	if (m_MatrixDirSwitched[iMatrixNum])
+	{
+		iLedStateNum = m_MatrixBase[iMatrixNum] - iLocalY * m_iNumMatrices;
+		iRow = 7 - iLocalY;
+		iBit = TwoToThe[7 - iLocalX];
+	}
+	else
+	{
+		iLedStateNum = m_MatrixBase[iMatrixNum] + iLocalY * m_iNumMatrices;
+		iRow = iLocalY;
+		iBit = TwoToThe[iLocalX];
+	}
+
+	return true;
+}
+
+//apply an operation to the LEDs from "iStartX" to "iEndX" in the line "iCoordY"
+void LedMatrix::FillSpan(int iCoordY, int iStartX, int iEndX, int iOperation)
+{
+	//ignore the LEDs outside of the clip area
+	if ((iCoordY < m_ClipArea[1]) || (iCoordY > m_ClipArea[3]))
+		return;
+	iStartX = max(iStartX, m_ClipArea[0]);
+	iEndX = min(iEndX, m_ClipArea[2]);
+	if (iStartX > iEndX)
+		return;
+
+	//precalculate these values, so they don't have to be re-calculated for each matrix
+	int iMatrixRowNum = (iCoordY >> 3) * m_iColumns;
+	int iLocalY = iCoordY & 7;
+	int iFirstMatrix = iStartX >> 3;
+	int iLastMatrix = iEndX >> 3;
+
+	//repeat for each matrix, the LEDs are displayed on
+	for (int i = iFirstMatrix; i <= iLastMatrix; i++)
+	{
+		//the first and the last LED on this matrix
+		int iFirstX = (i == iFirstMatrix) ? (iStartX & 7) : 0;
+		int iLastX = (i == iLastMatrix) ? (iEndX & 7) : 7;
+
+		int iMatrixNum = iMatrixRowNum + i;
+		if (m_MatrixDirSwitched[iMatrixNum])
+		{
+			//the LEDs of a turned matrix are stored in reversed order
+			ApplyPixels(m_MatrixBase[iMatrixNum] - iLocalY * m_iNumMatrices, 7 - iLocalY,
+				(0b11111111 << (7 - iLastX)) & (0b11111111 >> iFirstX), iOperation);
+		}
+		else
+		{
+			ApplyPixels(m_MatrixBase[iMatrixNum] + iLocalY * m_iNumMatrices, iLocalY,
+				(0b11111111 << iFirstX) & (0b11111111 >> (7 - iLastX)), iOperation);
+		}
+	}
+}
+
+//enable the LEDs of a line from one point to another (used for the outline of "DrawPolygon")
+void LedMatrix::DrawEdge(int iStartX, int iStartY, int iEndX, int iEndY)
+{
+	int iDiffX = abs(iEndX - iStartX);
+	int iDiffY = abs(iEndY - iStartY);
+	int iStepX = (iEndX < iStartX) ? -1 : 1;
+	int iStepY = (iEndY < iStartY) ? -1 : 1;
+
+	/*the coordinate, which changes the most, is moved by one LED in each step,
+	the other one is rounded (halves are rounded away from the start point)*/
+	int iMajor = max(iDiffX, iDiffY);
+	int iMinor = min(iDiffX, iDiffY);
+	int iError = iMajor;
+
+	int x = iStartX;
+	int y = iStartY;
+	int iRunStartX = iStartX;
+	for (int i = 0; i < iMajor; i++)
+	{
+		iError += 2 * iMinor;
+		bool bMinorStep = (iError >= 2 * iMajor);
+		if (bMinorStep)
+			iError -= 2 * iMajor;
+
+		if (iDiffX >= iDiffY)
+		{
+			//the LEDs in the same line are written at once, when the line changes
+			if (bMinorStep)
+			{
+				FillSpan(y, min(iRunStartX, x), max(iRunStartX, x), PIXEL_ON);
+				y += iStepY;
+				iRunStartX = x + iStepX;
+			}
+			x += iStepX;
+		}
+		else
+		{
+			//every line only contains one LED
+			FillSpan(y, x, x, PIXEL_ON);
+			if (bMinorStep)
+				x += iStepX;
+			y += iStepY;
+			iRunStartX = x;
+		}
+	}
+
+	//the LEDs of the last line
+	FillSpan(y, min(iRunStartX, x), max(iRunStartX, x), PIXEL_ON);
+}
+
+//get 8 LEDs of a row, which is stored like in "SetDisplay"
+int LedMatrix::GetRowBits(const char* pRow, int iWidth, int iCoordX)
+{
+	//the row doesn't contain any of the LEDs
+	if ((iCoordX <= -8) || (iCoordX >= 8 * iWidth))
+		return 0;
+
+	/*the 8 LEDs are spread over two bytes (unless "iCoordX" is a multiple of 8),
+	so get both of them and shift the LEDs into the first byte*/
+	int iByte = ((iCoordX + 8) >> 3) - 1;
+	int iShift = (iCoordX + 8) & 7;
+	unsigned int iBits = 0;
+	if (iByte >= 0)
+		iBits = (unsigned char)pRow[iByte] << 8;
+	if ((iShift != 0) && (iByte + 1 < iWidth))
+		iBits |= (unsigned char)pRow[iByte + 1];
+
+	return ((iBits << iShift) >> 8) & 0b11111111;
+}
+
+//insert a column of "DrawBars" into the list of columns, which is sorted from the highest to the lowest one
+void LedMatrix::InsertBarColumn(int* pLevels, char* pBits, int& iNum, int iLevel, char iBit)
+{
+	//columns without any enabled LEDs never reach a line
+	if (iLevel <= 0)
+		return;
+
+	int i = iNum++;
+	while ((i > 0) && (pLevels[i - 1] < iLevel))
+	{
+		pLevels[i] = pLevels[i - 1];
+		pBits[i] = pBits[i - 1];
+		i--;
+	}
+	pLevels[i] = iLevel;
+	pBits[i] = iBit;
+}
+
+//mark the LED rows dirty, which display the lines from "iTop" to "iBottom" of the display
+void LedMatrix::SetLinesDirty(int iTop, int iBottom)
+{
+	//ignore the lines outside of the display
+	iTop = max(iTop, 0);
+	iBottom = min(iBottom, 8 * m_iRows - 1);
+
+	//8 or more lines cover every LED row
+	if (iBottom - iTop >= 7)
+	{
+		m_iDirtyRows = 0b11111111;
+	}
+	else
+	{
+		for (int i = iTop; i <= iBottom; i++)
+		{
+			//the line is displayed by the LED row "i % 8" or, if the matrix is turned, by the LED row "7 - i % 8"
+			m_iDirtyRows |= TwoToThe[i & 7];
+			if (m_bAnyDirSwitched)
+				m_iDirtyRows |= TwoToThe[7 - (i & 7)];
+		}
+	}
+
+	//the layers don't change m_LedState, so "ResetClipArea" mustn't unmark these LED rows
+	if (m_bClipStatesValid)
+		m_iClipDirtyRows |= m_iDirtyRows;
+}
+
+//check whether at least one layer has to be combined with m_LedState
+bool LedMatrix::HasVisibleLayers()
+{
+	for (int i = 0; i < LED_MATRIX_MAX_LAYERS; i++)
+	{
+		if ((m_Layers[i].pStates != 0) && m_Layers[i].bVisible)
+			return true;
+	}
+
+	return false;
+}
+
+//mark the LED rows dirty, which display a layer
+void LedMatrix::SetLayerDirty(int iLayer)
+{
+	//a layer, which isn't displayed, doesn't change anything
+	if ((m_Layers[iLayer].pStates == 0) || !m_Layers[iLayer].bVisible)
+		return;
+
+	SetLinesDirty(m_Layers[iLayer].iOffsetY, m_Layers[iLayer].iOffsetY + m_Layers[iLayer].iHeight - 1);
+}
+
+//combine the LED states of one LED row of one controller with the visible layers
+char LedMatrix::BlendLayers(int iRow, int iController)
+{
+	char iStates = m_LedState[iController + iRow * m_iNumMatrices];
+
+	//find the line and the first LED on the display, which are shown by this LED row
+	int iMatrixNum = m_ControllerMatrix[iController];
+	bool bDirSwitched = m_MatrixDirSwitched[iMatrixNum];
+	int iCoordX = (iMatrixNum % m_iColumns) * 8;
+	int iCoordY = (iMatrixNum / m_iColumns) * 8 + (bDirSwitched ? 7 - iRow : iRow);
+
+	//repeat for each layer, beginning with the bottom one
+	for (int i = 0; i < LED_MATRIX_MAX_LAYERS; i++)
+	{
+		Layer& CurrLayer = m_Layers[i];
+		if ((CurrLayer.pStates == 0) || !CurrLayer.bVisible)
+			continue;
+
+		//the position of the LEDs in the layer
+		int iLayerX = iCoordX - CurrLayer.iOffsetX;
+		int iLayerY = iCoordY - CurrLayer.iOffsetY;
+
+		//skip the layer, if it doesn't cover this LED row
+		if ((iLayerY < 0) || (iLayerY >= CurrLayer.iHeight) || (iLayerX <= -8) || (iLayerX >= 8 * CurrLayer.iWidth))
+			continue;
+
+		//get the LEDs of the layer, which are on this matrix
+		int iLayerStates = GetRowBits(CurrLayer.pStates + iLayerY * CurrLayer.iWidth, CurrLayer.iWidth, iLayerX);
+
+		//the bits of a matrix, which isn't turned, are stored in reversed order (like in "SetDisplay")
+		if (!bDirSwitched)
+			iLayerStates = (ReversedNibble[iLayerStates & 0b1111] << 4) | ReversedNibble[iLayerStates >> 4];
+
+		//combine the layer with the LEDs below it
+		if (CurrLayer.iBlendMode == LAYER_XOR)
+			iStates ^= iLayerStates;
+		else if (CurrLayer.iBlendMode == LAYER_MASK)
+			iStates &= ~iLayerStates;
+		else
+			iStates |= iLayerStates;
+	}
+
+	return iStates;
+}
+
+//collect one LED of "SetPixels"
+void LedMatrix::AddPendingPixel(PendingPixels& Pending, int iCoordX, int iCoordY, int iOperation)
+{
+	int iLedStateNum;
+	int iRow;
+	char iBit;
+	if (!LocatePixel(iCoordX, iCoordY, iLedStateNum, iRow, iBit))
+		return;
+
+	//if the LED is in an other row than the previous ones, write the collected bits first
+	if (iLedStateNum != Pending.iLedStateNum)
+	{
+		if (Pending.iLedStateNum >= 0)
+			ApplyPixels(Pending.iLedStateNum, Pending.iRow, Pending.iBits, iOperation);
+		Pending.iLedStateNum = iLedStateNum;
+		Pending.iRow = iRow;
+		Pending.iBits = 0;
+	}
+
+	//inverting the same LED twice has to cancel out, so the bits are toggled instead of being set
+	if (iOperation == PIXEL_INVERT)
+		Pending.iBits ^= iBit;
+	else
+		Pending.iBits |= iBit;
+}
+
+//apply an operation to some bits of one LED row
+void LedMatrix::ApplyPixels(int iLedStateNum, int iRow, char iBits, int iOperation)
+{
+	char iNewState;
+	if (iOperation == PIXEL_ON)
+		iNewState = m_LedState[iLedStateNum] | iBits;
+	else if (iOperation == PIXEL_OFF)
+		iNewState = m_LedState[iLedStateNum] & ~iBits;
+	else
+		iNewState = m_LedState[iLedStateNum] ^ iBits;
+
+	//the LED row only has to be sent in the next update, if one of its LEDs really changed
+	if (iNewState != m_LedState[iLedStateNum])
+	{
+		m_LedState[iLedStateNum] = iNewState;
+		m_iDirtyRows |= TwoToThe[iRow];
+	}
+}
+
+
 
 //public functions
 //universal and specific functions for sending commands
@@ -309,6 +737,8 @@ void LedMatrix::ClearDisplay(bool bState)
 		//set the LED state to the value which was passed to this function
 		m_LedState[i] = iState;
 	}
+
+	m_iDirtyRows = 0b11111111;
 }
 
 //set every LED in one matrix either to be enabled or disabled
@@ -327,6 +757,70 @@ void LedMatrix::ClearMatrix(int iMatrix, bool bState)
 		//set the LED row to the value which was passed to this function
 		m_LedState[iMatrixNum + i * iMatricesPerRow] = iState;
 	}
+
+	m_iDirtyRows = 0b11111111;
+}
+
+//set every LED in a rectangular area either to be enabled or disabled
+void LedMatrix::ClearArea(int iLeft, int iTop, int iRight, int iBottom, bool bState)
+{
+	//repeat for each line of the area, which is in the clip area
+	for (int y = max(min(iTop, iBottom), m_ClipArea[1]); y <= min(max(iTop, iBottom), m_ClipArea[3]); y++)
+		FillSpan(y, min(iLeft, iRight), max(iLeft, iRight), bState ? PIXEL_ON : PIXEL_OFF);
+}
+
+//only let the drawing commands change the LEDs in a rectangular area
+void LedMatrix::SetClipArea(int iLeft, int iTop, int iRight, int iBottom)
+{
+	/*remember the LEDs before the first clip area is set, so "ResetClipArea" can find the LED rows,
+	which were changed and changed back (e.g. cleared and redrawn)*/
+	if (!m_bClipStatesValid)
+	{
+		if (m_ClipStates == 0)
+			m_ClipStates = new char[8 * m_iNumMatrices];
+		for (int i = 0; i < 8 * m_iNumMatrices; i++)
+			m_ClipStates[i] = m_LedState[i];
+		m_iClipDirtyRows = m_iDirtyRows;
+		m_bClipStatesValid = true;
+	}
+
+	//sort the coordinates and keep the area on the display
+	m_ClipArea[0] = max(min(iLeft, iRight), 0);
+	m_ClipArea[1] = max(min(iTop, iBottom), 0);
+	m_ClipArea[2] = min(max(iLeft, iRight), 8 * m_iColumns - 1);
+	m_ClipArea[3] = min(max(iTop, iBottom), 8 * m_iRows - 1);
+}
+
+//let the drawing commands change every LED of the display again
+void LedMatrix::ResetClipArea()
+{
+	//the LED rows, which were marked while the clip area was set, only have to be sent if one of their LEDs is different now
+	if (m_bClipStatesValid)
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			if (!(m_iDirtyRows & TwoToThe[i]) || (m_iClipDirtyRows & TwoToThe[i]))
+				continue;
+
+			bool bChanged = false;
+			for (int j = i * m_iNumMatrices; j < (i + 1) * m_iNumMatrices; j++)
+			{
+				if (m_LedState[j] != m_ClipStates[j])
+				{
+					bChanged = true;
+					break;
+				}
+			}
+			if (!bChanged)
+				m_iDirtyRows &= NotTwoToThe[i];
+		}
+		m_bClipStatesValid = false;
+	}
+
+	m_ClipArea[0] = 0;
+	m_ClipArea[1] = 0;
+	m_ClipArea[2] = 8 * m_iColumns - 1;
+	m_ClipArea[3] = 8 * m_iRows - 1;
 }
 
 //invert every LED in one matrix
@@ -371,6 +865,7 @@ void LedMatrix::SetLed(int iCoordX, int iCoordY, bool bState)
 		//if it is, we need to calculate a little bit more
 		iLedStateNum = (m_iNumMatrices - 1 - iFinalMatrix) + (7 * m_iNumMatrices) - (iLocalY * m_iNumMatrices);
 		iLocalX = 7 - iLocalX;
+		iLocalY = 7 - iLocalY;
 	}
 	else
 	{
@@ -379,10 +874,15 @@ void LedMatrix::SetLed(int iCoordX, int iCoordY, bool bState)
 	}
 
 	//set the correct index of the LED state list to the state which was passed to this function
+	char iOldState = m_LedState[iLedStateNum];
 	if (bState)
 		m_LedState[iLedStateNum] |= TwoToThe[iLocalX];
 	else
 		m_LedState[iLedStateNum] &= NotTwoToThe[iLocalX];
+
+	//the LED row only has to be sent in the next update, if the LED really changed
+	if (m_LedState[iLedStateNum] != iOldState)
+		m_iDirtyRows |= TwoToThe[iLocalY];
 }
 
 //set one Led to a specific state
@@ -407,6 +907,7 @@ void LedMatrix::InvertLed(int iCoordX, int iCoordY)
 		//if it is, we need to calculate a little bit more
 		iLedStateNum = (m_iNumMatrices - 1 - iFinalMatrix) + (7 * m_iNumMatrices) - (iLocalY * m_iNumMatrices);
 		iLocalX = 7 - iLocalX;
+		iLocalY = 7 - iLocalY;
 	}
 	else
 	{
@@ -414,6 +915,9 @@ void LedMatrix::InvertLed(int iCoordX, int iCoordY)
 		iLedStateNum = (m_iNumMatrices - 1 - iFinalMatrix) + (iLocalY * m_iNumMatrices);
 	}
 
+	//inverting always changes the LED, so the LED row has to be sent in the next update
+	m_iDirtyRows |= TwoToThe[iLocalY];
+
 	//set the correct index of the LED state list to the state which was passed to this function
 	//todo: test and performance comparison of m_LedState[iLedStateNum] = m_LedState[iLedStateNum] ^ TwoToThe[iLocalX];
 	if (m_LedState[iLedStateNum] & TwoToThe[iLocalX])
@@ -422,54 +926,80 @@ void LedMatrix::InvertLed(int iCoordX, int iCoordY)
 		m_LedState[iLedStateNum] |= TwoToThe[iLocalX];
 }
 
+//apply an operation to a list of LEDs given as x and y coordinates
+void LedMatrix::SetPixels(const uint8_t* pCoordsX, const uint8_t* pCoordsY, int iCount, int iOperation)
+{
+	PendingPixels Pending;
+	Pending.iLedStateNum = -1;
+
+	for (int i = 0; i < iCount; i++)
+		AddPendingPixel(Pending, pCoordsX[i], pCoordsY[i], iOperation);
+
+	//write the last collected bits
+	if (Pending.iLedStateNum >= 0)
+		ApplyPixels(Pending.iLedStateNum, Pending.iRow, Pending.iBits, iOperation);
+}
+
+//apply an operation to a list of LEDs given as packed points
+void LedMatrix::SetPixels(const uint16_t* pPoints, int iCount, int iOperation)
+{
+	PendingPixels Pending;
+	Pending.iLedStateNum = -1;
+
+	for (int i = 0; i < iCount; i++)
+		AddPendingPixel(Pending, pPoints[i] >> 8, pPoints[i] & 0xFF, iOperation);
+
+	//write the last collected bits
+	if (Pending.iLedStateNum >= 0)
+		ApplyPixels(Pending.iLedStateNum, Pending.iRow, Pending.iBits, iOperation);
+}
+
 //set each LED in the Matrix to a specific state
 void LedMatrix::SetDisplay(char* iStates)
 {
-	//repeat for each row
-	for (int i = 0; i < 8; i++)
-	{
-		//precalculate this value, so it doesn't have to be re-calculated in each loop
-		int iLedRowPreCalc = i * m_iNumMatrices;
+	//the position of each byte is only calculated once
+	if (m_DisplayMap == 0)
+		BuildDisplayMap();
 
-		//repeat for each matrix
-		for (int j = 0; j < m_iNumMatrices; j++)
+	//repeat for each LED row of each matrix
+	for (int i = 0; i < 8 * m_iNumMatrices; i++)
+	{
+		int iLedStateNum = m_DisplayMap[i];
+		if (iLedStateNum >= 0)
 		{
-			//get the number of the matrix, the pixel gets displayed on
-			int iFinalMatrix = m_MatrixConfig[j];
+			//the matrix is turned, so the bits are in the right order already
+			m_LedState[iLedStateNum] = iStates[i];
+		}
+		else
+		{
+			//reverse the order of the bits
+			m_LedState[~iLedStateNum] = (ReversedNibble[iStates[i] & 0b1111] << 4) | ReversedNibble[(iStates[i] >> 4) & 0b1111];
+		}
+	}
 
-			//in this variable the calculated index gets stored in
-			int iLedStateNum = 0;
+	m_iDirtyRows = 0b11111111;
+}
 
-			//precalculate some values, so they don't have to be re-calculated in each loop
-			int bStateNumPreCalc = (j % m_iColumns) + m_iColumns * (i + 8 * (j / m_iColumns));
-			int iFinalMatrixPreCalc = m_iNumMatrices - 1 - iFinalMatrix;
-			
-			/*before making calculations, we need to know whether the matrix,
-			where the point is displayed on is turned around by 180 or not*/
-			if (m_MatrixDirSwitched[j])
-			{
-				//if it is, we need to calculate a little bit more
-				iLedStateNum = iFinalMatrixPreCalc + (7 * m_iNumMatrices - iLedRowPreCalc);
-				
-				//set the correct index of the LED state list to the state which was passed to this function
-				m_LedState[iLedStateNum] = iStates[bStateNumPreCalc];
-			}
-			else
-			{
-				//if it isn't, just do the basic calculations
-				iLedStateNum = iFinalMatrixPreCalc + iLedRowPreCalc;
-				
-				//set the correct index of the LED state list to the state which was passed to this function
-				m_LedState[iLedStateNum] = 0;
-				m_LedState[iLedStateNum] |= (iStates[bStateNumPreCalc] << 7) & 128; //this is probably faster than a loop
-				m_LedState[iLedStateNum] |= (iStates[bStateNumPreCalc] << 5) & 64;
-				m_LedState[iLedStateNum] |= (iStates[bStateNumPreCalc] << 3) & 32;
-				m_LedState[iLedStateNum] |= (iStates[bStateNumPreCalc] << 1) & 16;
-				m_LedState[iLedStateNum] |= (iStates[bStateNumPreCalc] >> 1) & 8;
-				m_LedState[iLedStateNum] |= (iStates[bStateNumPreCalc] >> 3) & 4;
-				m_LedState[iLedStateNum] |= (iStates[bStateNumPreCalc] >> 5) & 2;
-				m_LedState[iLedStateNum] |= (iStates[bStateNumPreCalc] >> 7) & 1;
-			}
+//get the state of each LED in the Matrix
+void LedMatrix::GetDisplay(char* iStates)
+{
+	//the position of each byte is only calculated once
+	if (m_DisplayMap == 0)
+		BuildDisplayMap();
+
+	//repeat for each LED row of each matrix
+	for (int i = 0; i < 8 * m_iNumMatrices; i++)
+	{
+		int iLedStateNum = m_DisplayMap[i];
+		if (iLedStateNum >= 0)
+		{
+			iStates[i] = m_LedState[iLedStateNum];
+		}
+		else
+		{
+			//reverse the order of the bits
+			char iLedStates = m_LedState[~iLedStateNum];
+			iStates[i] = (ReversedNibble[iLedStates & 0b1111] << 4) | ReversedNibble[(iLedStates >> 4) & 0b1111];
 		}
 	}
 }
@@ -516,6 +1046,8 @@ void LedMatrix::SetMatrix(int iMatrix, char* iStates)
 			m_LedState[iLedStateNum] |= (iStates[i] >> 7) & 1;
 		}
 	}
+
+	m_iDirtyRows = 0b11111111;
 }
 
 
@@ -529,7 +1061,10 @@ void LedMatrix::DrawLine(int iStartX, int iStartY, int iEndX, int iEndY)
 
 	if ((Xdiff == 0) && (Ydiff == 0))
 	{
-		SetLed(iStartX, iStartY, true);
+		if ((iStartX >= m_ClipArea[0]) && (iStartX <= m_ClipArea[2]) && (iStartY >= m_ClipArea[1]) && (iStartY <= m_ClipArea[3]))
+		{
+			SetLed(iStartX, iStartY, true);
+		}
 	}
 	else if (abs(Xdiff) > abs(Ydiff))
 	{
@@ -542,7 +1077,7 @@ void LedMatrix::DrawLine(int iStartX, int iStartY, int iEndX, int iEndY)
 			int CurrX = (int)roundf(XCoeff * (float)i) + iStartX;
 			int CurrY = (int)roundf(YCoeff * (float)i) + iStartY;
 
-			if ((CurrX >= 0) && (CurrX <= 31) && (CurrY >= 0) && (CurrY <= 23))
+			if ((CurrX >= m_ClipArea[0]) && (CurrX <= m_ClipArea[2]) && (CurrY >= m_ClipArea[1]) && (CurrY <= m_ClipArea[3]))
 			{
 				SetLed(CurrX, CurrY, true);
 			}
@@ -559,7 +1094,7 @@ void LedMatrix::DrawLine(int iStartX, int iStartY, int iEndX, int iEndY)
 			int CurrX = (int)roundf(XCoeff * (float)i) + iStartX;
 			int CurrY = (int)roundf(YCoeff * (float)i) + iStartY;
 
-			if ((CurrX >= 0) && (CurrX <= 31) && (CurrY >= 0) && (CurrY <= 23))
+			if ((CurrX >= m_ClipArea[0]) && (CurrX <= m_ClipArea[2]) && (CurrY >= m_ClipArea[1]) && (CurrY <= m_ClipArea[3]))
 			{
 				SetLed(CurrX, CurrY, true);
 			}
@@ -568,18 +1103,408 @@ void LedMatrix::DrawLine(int iStartX, int iStartY, int iEndX, int iEndY)
 }
 
 //draw a rectangle
-//void LedMatrix::DrawRectangle(int iLeft, int iTop, int iRight, int iBottom, bool bFill);
+void LedMatrix::DrawRectangle(int iLeft, int iTop, int iRight, int iBottom, bool bFill)
+{
+	//a filled rectangle is the same as enabling every LED in the area
+	if (bFill)
+	{
+		ClearArea(iLeft, iTop, iRight, iBottom, true);
+		return;
+	}
+
+	//sort the coordinates
+	int iMinX = min(iLeft, iRight);
+	int iMaxX = max(iLeft, iRight);
+	int iMinY = min(iTop, iBottom);
+	int iMaxY = max(iTop, iBottom);
+
+	//draw the top and the bottom edge...
+	FillSpan(iMinY, iMinX, iMaxX, PIXEL_ON);
+	FillSpan(iMaxY, iMinX, iMaxX, PIXEL_ON);
+
+	//...and the left and the right one
+	for (int y = max(iMinY + 1, m_ClipArea[1]); y <= min(iMaxY - 1, m_ClipArea[3]); y++)
+	{
+		FillSpan(y, iMinX, iMinX, PIXEL_ON);
+		FillSpan(y, iMaxX, iMaxX, PIXEL_ON);
+	}
+}
+
+//draw a bitmap
+void LedMatrix::DrawBitmap(int iLeft, int iTop, const char* pStates, int iWidth, int iHeight)
+{
+	//only draw the matrices, which display a part of the bitmap inside of the clip area
+	int iStartX = max(iLeft, m_ClipArea[0]);
+	int iEndX = min(iLeft + 8 * iWidth - 1, m_ClipArea[2]);
+	if (iStartX > iEndX)
+		return;
+	int iFirstMatrixX = iStartX >> 3;
+	int iLastMatrixX = iEndX >> 3;
+
+	//the LEDs of the first and the last matrix, which are inside of the clip area (in the same order as in the bitmap)
+	int iFirstMask = 0b11111111 >> (iStartX & 7);
+	int iLastMask = (0b11111111 << (7 - (iEndX & 7))) & 0b11111111;
+
+	//repeat for each line of the bitmap, which is in the clip area
+	for (int y = max(iTop, m_ClipArea[1]); y <= min(iTop + iHeight - 1, m_ClipArea[3]); y++)
+	{
+		const char* pRow = pStates + (y - iTop) * iWidth;
+		int iMatrixRowNum = (y >> 3) * m_iColumns;
+		int iLocalY = y & 7;
+
+		//repeat for each matrix in this line
+		for (int i = iFirstMatrixX; i <= iLastMatrixX; i++)
+		{
+			//get the LEDs of the bitmap, which are on this matrix
+			int iBits = GetRowBits(pRow, iWidth, 8 * i - iLeft);
+			if (i == iFirstMatrixX)
+				iBits &= iFirstMask;
+			if (i == iLastMatrixX)
+				iBits &= iLastMask;
+			if (iBits == 0)
+				continue;
+
+			int iMatrixNum = iMatrixRowNum + i;
+			if (m_MatrixDirSwitched[iMatrixNum])
+			{
+				ApplyPixels(m_MatrixBase[iMatrixNum] - iLocalY * m_iNumMatrices, 7 - iLocalY, iBits, PIXEL_ON);
+			}
+			else
+			{
+				//the bits of a matrix, which isn't turned, are stored in reversed order (like in "SetDisplay")
+				ApplyPixels(m_MatrixBase[iMatrixNum] + iLocalY * m_iNumMatrices, iLocalY,
+					(ReversedNibble[iBits & 0b1111] << 4) | ReversedNibble[iBits >> 4], PIXEL_ON);
+			}
+		}
+	}
+}
 
 //draw an ellipse
 //void LedMatrix::DrawEllipse(int iCenterX, int iCenterY, int iRadiusX, int iRadiusY, bool bFill);
 
+//draw vertical bars
+void LedMatrix::DrawBars(const uint8_t* pHeights, int iCount, int iBarWidth, int iGap, int iMode, uint8_t* pPeaks)
+{
+	//the height of the display and the width of all bars together
+	int iDisplayHeight = 8 * m_iRows;
+	int iBarsWidth = min(iCount * (iBarWidth + iGap) - iGap, 8 * m_iColumns);
+	if ((iBarWidth <= 0) || (iBarsWidth <= 0))
+		return;
+
+	//let the peaks fall or rise to the height of their bar
+	if (pPeaks)
+	{
+		for (int i = 0; i < iCount; i++)
+		{
+			if (pHeights[i] >= pPeaks[i])
+				pPeaks[i] = pHeights[i];
+			else
+				pPeaks[i]--;
+		}
+	}
+
+	//the position of the first LED of the current matrix column in the bars
+	int iBar = 0;
+	int iBarPos = 0;
+
+	//repeat for each column of matrices, which displays the bars
+	for (int iMatrixX = 0; iMatrixX < ((iBarsWidth + 7) >> 3); iMatrixX++)
+	{
+		/*get the height and the peak of each column of LEDs on this matrix,
+		sorted from the highest to the lowest one together with the bit of the column*/
+		int iHeights[8];
+		char iHeightBits[8];
+		int iNumHeights = 0;
+		int iPeaks[8];
+		char iPeakBits[8];
+		int iNumPeaks = 0;
+		char iAreaBits = 0;
+		for (int i = 0; i < 8; i++)
+		{
+			//only the LEDs in the area of the bars are changed
+			if (8 * iMatrixX + i >= iBarsWidth)
+				continue;
+			iAreaBits |= TwoToThe[i];
+
+			//the LEDs in the gaps stay disabled
+			if (iBarPos < iBarWidth)
+			{
+				InsertBarColumn(iHeights, iHeightBits, iNumHeights, min((int)pHeights[iBar], iDisplayHeight), TwoToThe[i]);
+				if (pPeaks)
+					InsertBarColumn(iPeaks, iPeakBits, iNumPeaks, min((int)pPeaks[iBar], iDisplayHeight), TwoToThe[i]);
+			}
+
+			//go to the next column of LEDs
+			if (++iBarPos == iBarWidth + iGap)
+			{
+				iBar++;
+				iBarPos = 0;
+			}
+		}
+
+		//the next column, which reaches the current line, and the columns, which reached one of the lines above
+		int iNextHeight = 0;
+		int iNextPeak = 0;
+		char iFilledBits = 0;
+
+		//repeat for each matrix in this column of matrices (from the top to the bottom)
+		for (int iMatrixY = 0; iMatrixY < m_iRows; iMatrixY++)
+		{
+			int iMatrixNum = iMatrixY * m_iColumns + iMatrixX;
+			bool bDirSwitched = m_MatrixDirSwitched[iMatrixNum];
+
+			//repeat for each line of the matrix
+			for (int iLocalY = 0; iLocalY < 8; iLocalY++)
+			{
+				//the height of this line above the bottom of the display
+				int iLevel = iDisplayHeight - 8 * iMatrixY - iLocalY;
+
+				//add the bits of the columns, which end in this line (the columns are sorted, so only the next ones have to be checked)
+				char iTopBits = 0;
+				while ((iNextHeight < iNumHeights) && (iHeights[iNextHeight] == iLevel))
+					iTopBits |= iHeightBits[iNextHeight++];
+				iFilledBits |= iTopBits;
+
+				//a filled bar keeps every bit below its top, otherwise only the top LED and the peak are enabled
+				char iBarBits = (iMode == BARS_FILLED) ? iFilledBits : iTopBits;
+				while ((iNextPeak < iNumPeaks) && (iPeaks[iNextPeak] == iLevel))
+					iBarBits |= iPeakBits[iNextPeak++];
+
+				//the LEDs of a turned matrix are stored in reversed order and from the bottom to the top
+				int iLedStateNum;
+				int iRow;
+				char iMask = iAreaBits;
+				if (bDirSwitched)
+				{
+					iLedStateNum = m_MatrixBase[iMatrixNum] - iLocalY * m_iNumMatrices;
+					iRow = 7 - iLocalY;
+					iBarBits = (ReversedNibble[iBarBits & 0b1111] << 4) | ReversedNibble[(iBarBits >> 4) & 0b1111];
+					iMask = (ReversedNibble[iMask & 0b1111] << 4) | ReversedNibble[(iMask >> 4) & 0b1111];
+				}
+				else
+				{
+					iLedStateNum = m_MatrixBase[iMatrixNum] + iLocalY * m_iNumMatrices;
+					iRow = iLocalY;
+				}
+
+				//only LED rows, which really changed, have to be sent in the next update
+				char iStates = (m_LedState[iLedStateNum] & ~iMask) | iBarBits;
+				if (iStates != m_LedState[iLedStateNum])
+				{
+					m_LedState[iLedStateNum] = iStates;
+					m_iDirtyRows |= TwoToThe[iRow];
+				}
+			}
+		}
+	}
+}
+
 //draw a polygon
-//void LedMatrix::DrawPolygon(int* PointX, int* PointX, int PointCount);
+bool LedMatrix::DrawPolygon(int* PointX, int* PointY, int PointCount, bool bFill, PolygonEdge* pEdges, int iMaxEdges)
+{
+	if (PointCount <= 0)
+		return true;
+
+	if (bFill)
+	{
+		//collect the edges, which aren't horizontal, and the lines the polygon covers
+		int iNumEdges = 0;
+		int iTop = PointY[0];
+		int iBottom = PointY[0];
+		for (int i = 0; i < PointCount; i++)
+		{
+			int iNext = (i + 1 < PointCount) ? i + 1 : 0;
+			iTop = min(iTop, PointY[i]);
+			iBottom = max(iBottom, PointY[i]);
+
+			//horizontal edges don't cross any line, they are drawn together with the outline
+			if (PointY[i] == PointY[iNext])
+				continue;
+
+			//there isn't enough memory for all of the edges
+			if (iNumEdges >= iMaxEdges)
+				return false;
+
+			//store the edge from the top to the bottom
+			int iUpper = (PointY[i] < PointY[iNext]) ? i : iNext;
+			int iLower = (PointY[i] < PointY[iNext]) ? iNext : i;
+			PolygonEdge& CurrEdge = pEdges[iNumEdges++];
+			CurrEdge.iTop = PointY[iUpper];
+			CurrEdge.iBottom = PointY[iLower];
+			//(multiplied instead of shifted, because the coordinates can be negative)
+			CurrEdge.lStepX = (long)(PointX[iLower] - PointX[iUpper]) * 65536L / (CurrEdge.iBottom - CurrEdge.iTop);
+			//add a half, so the x coordinates get rounded instead of truncated
+			CurrEdge.lCurrX = (long)PointX[iUpper] * 65536L + 0x8000;
+		}
+
+		//only fill the lines, which are in the clip area
+		int iFirstLine = max(iTop, m_ClipArea[1]);
+		int iLastLine = min(iBottom, m_ClipArea[3] + 1);
+
+		//move the edges, which begin above the clip area, to the first line in the clip area
+		for (int i = 0; i < iNumEdges; i++)
+		{
+			if (pEdges[i].iTop < iFirstLine)
+				pEdges[i].lCurrX += (long)(min(iFirstLine, pEdges[i].iBottom) - pEdges[i].iTop) * pEdges[i].lStepX;
+		}
+
+		//repeat for each line
+		for (int y = iFirstLine; y < iLastLine; y++)
+		{
+			//move the edges, which cross this line, to the beginning of the list
+			int iNumActive = 0;
+			for (int i = 0; i < iNumEdges; i++)
+			{
+				if ((pEdges[i].iTop <= y) && (pEdges[i].iBottom > y))
+				{
+					PolygonEdge TempEdge = pEdges[iNumActive];
+					pEdges[iNumActive++] = pEdges[i];
+					pEdges[i] = TempEdge;
+				}
+			}
+
+			/*sort them from the left to the right
+			(the order barely changes from one line to the next, so insertion sort is fast enough)*/
+			for (int i = 1; i < iNumActive; i++)
+			{
+				PolygonEdge CurrEdge = pEdges[i];
+				int j = i;
+				while ((j > 0) && (pEdges[j - 1].lCurrX > CurrEdge.lCurrX))
+				{
+					pEdges[j] = pEdges[j - 1];
+					j--;
+				}
+				pEdges[j] = CurrEdge;
+			}
+
+			//fill the LEDs between each pair of edges
+			for (int i = 0; i + 1 < iNumActive; i += 2)
+				FillSpan(y, (int)(pEdges[i].lCurrX >> 16), (int)(pEdges[i + 1].lCurrX >> 16), PIXEL_ON);
+
+			//move the edges to the next line
+			for (int i = 0; i < iNumActive; i++)
+				pEdges[i].lCurrX += pEdges[i].lStepX;
+		}
+	}
+
+	//draw the outline (a filled polygon needs it too, because the bottom line and the horizontal edges aren't filled)
+	for (int i = 0; i < PointCount; i++)
+	{
+		int iNext = (i + 1 < PointCount) ? i + 1 : 0;
+		DrawEdge(PointX[i], PointY[i], PointX[iNext], PointY[iNext]);
+	}
+
+	return true;
+}
+
+
+
+//layers
+//set the buffer of a layer
+void LedMatrix::SetLayer(int iLayer, char* pStates, int iWidth, int iHeight, int iBlendMode)
+{
+	if ((iLayer < 0) || (iLayer >= LED_MATRIX_MAX_LAYERS))
+		return;
+
+	//the LEDs, which displayed the old layer, have to be updated
+	SetLayerDirty(iLayer);
+
+	m_Layers[iLayer].pStates = pStates;
+	m_Layers[iLayer].iWidth = iWidth;
+	m_Layers[iLayer].iHeight = iHeight;
+	m_Layers[iLayer].iOffsetX = 0;
+	m_Layers[iLayer].iOffsetY = 0;
+	m_Layers[iLayer].iBlendMode = iBlendMode;
+	m_Layers[iLayer].bVisible = (pStates != 0);
+
+	//...and the LEDs, which display the new one
+	SetLayerDirty(iLayer);
+}
+
+//show or hide a layer
+void LedMatrix::SetLayerVisible(int iLayer, bool bVisible)
+{
+	if ((iLayer < 0) || (iLayer >= LED_MATRIX_MAX_LAYERS) || (m_Layers[iLayer].bVisible == bVisible))
+		return;
+
+	//mark the layer dirty while it is visible
+	SetLayerDirty(iLayer);
+	m_Layers[iLayer].bVisible = bVisible;
+	SetLayerDirty(iLayer);
+}
+
+//move a layer
+void LedMatrix::SetLayerOffset(int iLayer, int iOffsetX, int iOffsetY)
+{
+	if ((iLayer < 0) || (iLayer >= LED_MATRIX_MAX_LAYERS))
+		return;
+
+	//both the old and the new position of the layer have to be updated
+	SetLayerDirty(iLayer);
+	m_Layers[iLayer].iOffsetX = iOffsetX;
+	m_Layers[iLayer].iOffsetY = iOffsetY;
+	SetLayerDirty(iLayer);
+}
+
+//change how a layer is combined with the LEDs below it
+void LedMatrix::SetLayerBlendMode(int iLayer, int iBlendMode)
+{
+	if ((iLayer < 0) || (iLayer >= LED_MATRIX_MAX_LAYERS))
+		return;
+
+	m_Layers[iLayer].iBlendMode = iBlendMode;
+	SetLayerDirty(iLayer);
+}
+
+//set one Led of a layer to a specific state
+void LedMatrix::SetLayerLed(int iLayer, int iCoordX, int iCoordY, bool bState)
+{
+	if ((iLayer < 0) || (iLayer >= LED_MATRIX_MAX_LAYERS) || (m_Layers[iLayer].pStates == 0))
+		return;
+
+	Layer& CurrLayer = m_Layers[iLayer];
+	if ((iCoordX < 0) || (iCoordX >= 8 * CurrLayer.iWidth) || (iCoordY < 0) || (iCoordY >= CurrLayer.iHeight))
+		return;
+
+	//the first LED is stored in the highest bit (like in "SetDisplay")
+	char* pLayerStates = CurrLayer.pStates + iCoordY * CurrLayer.iWidth + (iCoordX >> 3);
+	if (bState)
+		*pLayerStates |= TwoToThe[7 - (iCoordX & 7)];
+	else
+		*pLayerStates &= NotTwoToThe[7 - (iCoordX & 7)];
+
+	//only the line of the LED has to be updated
+	if (CurrLayer.bVisible)
+		SetLinesDirty(iCoordY + CurrLayer.iOffsetY, iCoordY + CurrLayer.iOffsetY);
+}
+
+//set every LED of a layer either to be enabled or disabled
+void LedMatrix::ClearLayer(int iLayer, bool bState)
+{
+	if ((iLayer < 0) || (iLayer >= LED_MATRIX_MAX_LAYERS) || (m_Layers[iLayer].pStates == 0))
+		return;
+
+	//either all LEDs in a byte are enabled or they are disabled
+	char iState = bState ? 0b11111111 : 0b00000000;
+	for (int i = 0; i < m_Layers[iLayer].iWidth * m_Layers[iLayer].iHeight; i++)
+		m_Layers[iLayer].pStates[i] = iState;
+
+	SetLayerDirty(iLayer);
+}
+
+//tell the library, that the buffer of a layer was changed directly
+void LedMatrix::LayerChanged(int iLayer)
+{
+	if ((iLayer < 0) || (iLayer >= LED_MATRIX_MAX_LAYERS))
+		return;
+
+	SetLayerDirty(iLayer);
+}
 
 
 
 //update the matrix
-void LedMatrix::UpdateMatrix()
+void LedMatrix::UpdateMatrix(bool bSendAll)
 {
 	//get the values ?????????????????? to speed things up
 	int iMOSIPin = TwoToThe[m_iMOSIPinNum];
@@ -588,24 +1513,22 @@ void LedMatrix::UpdateMatrix()
 	int iNotCLKPin = NotTwoToThe[m_iCLKPinNum];
 	//todo: check, if storing CSPin and NotCSPin in a local variable makes it faster
 
-	int iTotalColumns = m_iNumMatrices;
+	//the layers only need to be combined with m_LedState, if at least one of them is visible
+	bool bBlendLayers = HasVisibleLayers();
+
+	//send every LED row again, if the caller asks for it (e.g. after the controllers lost their data)
+	if (bSendAll)
+		m_iDirtyRows = 0b11111111;
 
 	//repeat the process for each row
 	for (int i = 0; i < 8; i++)
 	{
-		//set the CS pin to low, so we can send data to the matrix controller
-		*m_pCSPinReg &= NotTwoToThe[m_iCSPinNum];
-
-		//repeat it for each matrix
-		for (int j = 0; j < iTotalColumns; j++)
-		{
-			//send the LED states to the matrix controller
-			SendLEDStates(&iMOSIPin, &iNotMOSIPin, &iCLKPin, &iNotCLKPin, i + 1, j + iTotalColumns * i);
-		}
-
-		/*set the CS pin to high, so the data get latched into the registers of the controller
-		and the LEDs get enabled*/
-		*m_pCSPinReg |= TwoToThe[m_iCSPinNum];
+		//skip the rows, which didn't change since the last update
+		if (m_iDirtyRows & TwoToThe[i])
+			SendRow(&iMOSIPin, &iNotMOSIPin, &iCLKPin, &iNotCLKPin, i, bBlendLayers);
 	}
 
+	//every LED row is up to date now (so the copy of the clip area doesn't show the sent LEDs anymore)
+	m_iDirtyRows = 0;
+	m_bClipStatesValid = false;
 }
\ No newline at end of file
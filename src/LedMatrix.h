@@ -14,6 +14,40 @@ const int TwoToThe[]	= { 0b00000001, 0b00000010, 0b00000100, 0b00001000, 0b00010
 //a list which represents the binary inverse of the values in the list above
 const int NotTwoToThe[]	= { 0b11111110, 0b11111101, 0b11111011, 0b11110111, 0b11101111, 0b11011111, 0b10111111, 0b01111111 };
 
+//the operations, which can be applied to the LEDs passed to "SetPixels"
+const int PIXEL_OFF		= 0;
+const int PIXEL_ON		= 1;
+const int PIXEL_INVERT	= 2;
+
+//a list which contains the values from 0 to 15 with their 4 bits in reversed order
+const int ReversedNibble[]	= { 0b0000, 0b1000, 0b0100, 0b1100, 0b0010, 0b1010, 0b0110, 0b1110, 0b0001, 0b1001, 0b0101, 0b1101, 0b0011, 0b1011, 0b0111, 0b1111 };
+
+//the ways a layer can be combined with the LEDs below it
+const int LAYER_OR		= 0; //the LEDs of the layer are enabled additionally
+const int LAYER_XOR		= 1; //the LEDs of the layer invert the LEDs below
+const int LAYER_MASK	= 2; //the LEDs of the layer disable the LEDs below
+
+//the ways the bars of "DrawBars" can be drawn
+const int BARS_FILLED	= 0; //every LED from the bottom to the height of the bar is enabled
+const int BARS_DOT		= 1; //only the top LED of the bar is enabled
+
+//the maximum number of layers (the library is compiled separately from the sketch, so this can't be changed there)
+const int LED_MATRIX_MAX_LAYERS	= 2;
+
+//the class, which connects multiple LedMatrix chains to the same data and clock pins (see "LedMatrixBus.h")
+class LedMatrixBus;
+
+
+
+//one edge of a polygon, which is filled by "DrawPolygon"
+struct PolygonEdge
+{
+	int iTop; //the first line of the display, which is crossed by the edge
+	int iBottom; //the line below the last line, which is crossed by the edge
+	long lCurrX; //the x coordinate of the edge in the current line (with 16 bits after the point)
+	long lStepX; //how much the x coordinate changes from one line to the next (with 16 bits after the point)
+};
+
 
 
 //the LedMatrix class
@@ -21,10 +55,22 @@ class LedMatrix
 {
 private: //private class members
 
+	//the bus needs access to the functions for sending data
+	friend class LedMatrixBus;
+
 	//the arrangement of the matrices
 	int* m_MatrixConfig;
 	bool* m_MatrixDirSwitched;
 
+	//the index in m_LedState of the first LED row of each matrix (already corrected for turned matrices)
+	int* m_MatrixBase;
+	//the number of the matrix, which is displayed by each controller (in the order of m_LedState)
+	int* m_ControllerMatrix;
+	//is at least one of the matrices turned by 180
+	bool m_bAnyDirSwitched;
+	//the index in m_LedState of each byte of "SetDisplay" (inverted, if the bits have to be reversed)
+	int* m_DisplayMap;
+
 	//number of matrices overall
 	int m_iNumMatrices;
 
@@ -35,6 +81,29 @@ private: //private class members
 	//the state of each Led in the matrix
 	char* m_LedState;
 
+	//the LED rows, which were changed since the last update (one bit per row)
+	int m_iDirtyRows;
+
+	//the area, the drawing commands are allowed to change (left, top, right, bottom)
+	int m_ClipArea[4];
+	//the state of each LED and the dirty LED rows before the first clip area was set (only valid until the next update)
+	char* m_ClipStates;
+	int m_iClipDirtyRows;
+	bool m_bClipStatesValid;
+
+	//the layers, which are drawn on top of m_LedState
+	struct Layer
+	{
+		char* pStates; //the states of the LEDs in the layer (in the same format as in "SetDisplay")
+		int iWidth; //the width of the layer in bytes (8 LEDs per byte)
+		int iHeight; //the height of the layer in LEDs
+		int iOffsetX; //the position of the top left corner of the layer on the display
+		int iOffsetY;
+		int iBlendMode; //how the layer is combined with the LEDs below it
+		bool bVisible;
+	};
+	Layer m_Layers[LED_MATRIX_MAX_LAYERS];
+
 	//the pin registers
 	int* m_pMOSIPinReg;
 	int* m_pCLKPinReg;
@@ -44,13 +113,79 @@ private: //private class members
 	int m_iCLKPinNum;
 	int m_iCSPinNum;
 
+	//the bus, which sends the data of this chain (0 if the chain sends its data on its own)
+	LedMatrixBus* m_pBus;
+
+
+	//calculate m_DisplayMap
+	void BuildDisplayMap();
+
+	//set up the class members and the pins (used by both constructors)
+	void Setup(int iDataPin, int iClkPin, int iCSPin, int* MatrixConfig, bool* bSwitchedDir, int iMatrixNumColumns, int iMatrixNumRows);
+
+	//initialize the matrices of this chain (used by both constructors, unless the chain is initialized by a bus)
+	void InitMatrices(int iLEDIntensity);
+
+	//a chain can't be copied, because its bus stores its address and the copy would free the same memory again
+	//(create it with "LedMatrix lm(...);" instead of "LedMatrix lm = LedMatrix(...);")
+	LedMatrix(const LedMatrix&);
+	LedMatrix& operator=(const LedMatrix&);
+
 
 	//functions for sending data to the LED matrix
 	//send data to the matrix controller(s)
 	void SendData(int iAddress, int iData);
 
-	//send 8 values from m_LedState to the matrix controller
-	void SendLEDStates(int* iMOSIPin, int* iNotMOSIPin, int* iCLKPin, int* iNotCLKPin, int iAddress, int iBegin);
+	//send 8 LED states to the matrix controller
+	void SendLEDStates(int* iMOSIPin, int* iNotMOSIPin, int* iCLKPin, int* iNotCLKPin, int iAddress, char iStates);
+
+	//send one LED row to every matrix controller
+	void SendRow(int* iMOSIPin, int* iNotMOSIPin, int* iCLKPin, int* iNotCLKPin, int iRow, bool bBlendLayers);
+
+
+	//helper functions for setting LEDs
+	//find the index in m_LedState, the LED row and the bit of the LED at the given coordinates (returns false if it is outside of the clip area)
+	bool LocatePixel(int iCoordX, int iCoordY, int& iLedStateNum, int& iRow, char& iBit);
+
+	//the LEDs of "SetPixels", which are in the same LED row and are written at once
+	struct PendingPixels
+	{
+		int iLedStateNum; //the index in m_LedState (-1 if no LED was collected yet)
+		int iRow;
+		char iBits;
+	};
+
+	//collect one LED of "SetPixels" and write the previously collected ones, if it is in an other LED row
+	void AddPendingPixel(PendingPixels& Pending, int iCoordX, int iCoordY, int iOperation);
+
+	//apply an operation to the bits "iBits" of m_LedState[iLedStateNum], which is in the LED row "iRow"
+	void ApplyPixels(int iLedStateNum, int iRow, char iBits, int iOperation);
+
+	//apply an operation to the LEDs from "iStartX" to "iEndX" in the line "iCoordY" (up to 8 LEDs at once)
+	void FillSpan(int iCoordY, int iStartX, int iEndX, int iOperation);
+
+	//enable the LEDs of a line from one point to another with integer steps (LEDs in the same line are written at once)
+	void DrawEdge(int iStartX, int iStartY, int iEndX, int iEndY);
+
+	//insert a column of "DrawBars" with the height "iLevel" and the bit "iBit" into a list, which is sorted from the highest to the lowest column
+	void InsertBarColumn(int* pLevels, char* pBits, int& iNum, int iLevel, char iBit);
+
+	//get the 8 LEDs beginning at the LED "iCoordX" of a row, which is "iWidth" bytes wide and stored like in "SetDisplay" (LEDs outside of the row are disabled)
+	int GetRowBits(const char* pRow, int iWidth, int iCoordX);
+
+
+	//helper functions for the layers
+	//mark the LED rows dirty, which display the lines from "iTop" to "iBottom" of the display
+	void SetLinesDirty(int iTop, int iBottom);
+
+	//check whether at least one layer has to be combined with m_LedState
+	bool HasVisibleLayers();
+
+	//mark the LED rows dirty, which display a layer
+	void SetLayerDirty(int iLayer);
+
+	//combine the LED states of one LED row of one controller with the visible layers
+	char BlendLayers(int iRow, int iController);
 
 
 public: //public class members
@@ -113,8 +248,24 @@ public: //public class members
 
 	*/
 
+	//use the data and clock pins of a bus, which are shared with other chains of matrices (see "LedMatrixBus.h")
+	//the matrices are initialized by "LedMatrixBus::Begin" instead of the constructor
+	//if there are already LED_MATRIX_BUS_MAX_CHAINS chains on the bus, the chain is initialized and updated on its own (see "IsOnBus")
+	LedMatrix(LedMatrixBus* pBus, //the bus, the chain is connected to
+		int iCSPin, //the ID of the pin, which is connected to "CS" on the MAX7221
+		int* MatrixConfig, //how the matrices are connected to each other (see above)
+		bool* bSwitchedDir, //tells the library if the matrices are turned by 180
+		int iMatrixNumColumns, // how much matrices are in a column
+		int iMatrixNumRows, //how much matrices are there in a row
+		int iLEDIntensity = 8); //the intensity of the LEDs, if the chain couldn't be added to the bus
+
+	//the chain is removed from its bus
 	~LedMatrix();
 
+	//is the chain updated by a bus
+	//if not, "UpdateMatrix" has to be called instead of "LedMatrixBus::FlushAll"
+	bool IsOnBus();
+
 
 	//send different commands (universal and specific functions)
 	//send any command
@@ -135,6 +286,23 @@ public: //public class members
 	//set every LED in one matrix either to be enabled or disabled
 	void ClearMatrix(int iMatrix, bool bState = false);
 
+	//set every LED in a rectangular area either to be enabled or disabled
+	void ClearArea(int iLeft, int iTop, int iRight, int iBottom, bool bState = false);
+
+	//only let the drawing commands change the LEDs in a rectangular area (the area is kept on the display)
+	void SetClipArea(int iLeft, int iTop, int iRight, int iBottom);
+	//let the drawing commands change every LED of the display again
+	void ResetClipArea();
+
+	/*
+	the clip area is used by "ClearArea", "SetPixels", "DrawLine", "DrawRectangle", "DrawBitmap" and "DrawPolygon",
+	every other function still changes the LEDs outside of it
+
+	"ResetClipArea" also unmarks the LED rows, which look the same as before the first "SetClipArea" call
+	(e.g. after clearing and redrawing an area), so they aren't sent again in the next update
+	--> a copy of the LED states is created, when a clip area is set for the first time
+	*/
+
 	//invert every LED in one matrix
 	//void InvertMatrixStates(int iMatrix);
 	
@@ -144,11 +312,27 @@ public: //public class members
 	//invert the state of a specific LED
 	void InvertLed(int iCoordX, int iCoordY);
 
+	//apply an operation (PIXEL_OFF, PIXEL_ON or PIXEL_INVERT) to a list of LEDs
+	//LEDs outside of the clip area are skipped
+	//...given as two lists with the x and y coordinates
+	void SetPixels(const uint8_t* pCoordsX, const uint8_t* pCoordsY, int iCount, int iOperation = PIXEL_ON);
+	//...given as one list of packed points (x in the high byte and y in the low byte, e.g. (x << 8) | y)
+	void SetPixels(const uint16_t* pPoints, int iCount, int iOperation = PIXEL_ON);
+
+	/*
+	"SetPixels" is a lot faster than calling "SetLed" for each LED, because the position of each matrix is only calculated once
+	and consecutive LEDs, which are stored in the same byte (same matrix and same row), are written at once
+
+	--> sort the list by y first and x second (or at least keep neighboring LEDs together) to get the most out of it
+	*/
+
 	//set the LED in a specific area to a specific state
 	//void SetSubMatrix(bool* bStates, int iMatrixWidth, int iMatrixHeight);
 
 	//set each LED of each matrix to an individual state
 	void SetDisplay(char* iStates);
+	//get the state of each LED of each matrix (in the same format as in "SetDisplay", the layers are not included)
+	void GetDisplay(char* iStates);
 	//set each LED in one Matrix to an individual state
 	void SetMatrix(int iMatrix, char* iStates);
 
@@ -195,17 +379,86 @@ public: //public class members
 	void DrawLine(int iStartX, int iStartY, int iEndX, int iEndY);
 	
 	//draw a rectangle
-	//void DrawRectangle(int iLeft, int iTop, int iRight, int iBottom, bool bFill);
+	void DrawRectangle(int iLeft, int iTop, int iRight, int iBottom, bool bFill);
+
+	//draw a bitmap, which is stored in the same format as in "SetDisplay" ("iWidth" bytes per line and "iHeight" lines)
+	//only the enabled LEDs of the bitmap are drawn, the other LEDs stay as they are
+	void DrawBitmap(int iLeft, int iTop, const char* pStates, int iWidth, int iHeight);
 
 	//draw an ellipse
 	//void DrawEllipse(int iCenterX, int iCenterY, int iRadiusX, int iRadiusY, bool bFill);
 
+	//draw vertical bars, which begin at the bottom of the display (e.g. for VU meters)
+	void DrawBars(const uint8_t* pHeights, int iCount, int iBarWidth, int iGap, int iMode = BARS_FILLED, uint8_t* pPeaks = 0);
+
+	/*
+	the bars are drawn from the left edge of the display, each bar is "iBarWidth" LEDs wide and "iGap" LEDs are left free between them
+	the whole area of the bars (from the top to the bottom of the display) is redrawn, so the previous bars don't have to be cleared
+
+	if "pPeaks" is passed, one LED is enabled above each bar at the highest height of the bar
+	the peaks are stored in "pPeaks" (one per bar, initialize it with 0) and fall by one LED each time "DrawBars" is called
+
+	e.g. 8 bars, which are 3 LEDs wide, with a gap of 1 LED
+	uint8_t Heights[8];
+	uint8_t Peaks[8] = { 0 };
+	lm.DrawBars(Heights, 8, 3, 1, BARS_FILLED, Peaks);
+	*/
+
 	//draw a polygon
-	//void DrawPolygon(int* PointX, int* PointX, int PointCount);
+	//returns false, if the polygon should be filled but "pEdges" is too small (nothing is drawn in that case)
+	bool DrawPolygon(int* PointX, int* PointY, int PointCount, bool bFill = false, PolygonEdge* pEdges = 0, int iMaxEdges = 0);
+
+	/*
+	"PointX" and "PointY" are the coordinates of the corners of the polygon, the last corner is connected to the first one
+	the polygon may be concave and its edges may cross each other (the areas which are surrounded an odd number of times are filled)
+
+	to fill a polygon, "DrawPolygon" needs some memory to store its edges in,
+	which has to be passed as "pEdges" and must be big enough for one edge per corner
+
+	e.g.
+	int PointX[] = { 2, 13, 13, 7, 2 };
+	int PointY[] = { 2, 2, 13, 7, 13 };
+	PolygonEdge Edges[5];
+	lm.DrawPolygon(PointX, PointY, 5, true, Edges, 5);
+	*/
+
+
+	//layers
+	//set the buffer of a layer, which is drawn on top of the LEDs set by the other functions (pass 0 as "pStates" to remove the layer)
+	//the buffer has to stay valid as long as the layer is used and stores the LEDs in the same format as in "SetDisplay"
+	//"iLayer" can range from 0 (bottom) to LED_MATRIX_MAX_LAYERS - 1 (top)
+	void SetLayer(int iLayer, char* pStates, int iWidth, int iHeight, int iBlendMode = LAYER_OR);
+
+	//change how a layer is displayed
+	void SetLayerVisible(int iLayer, bool bVisible);
+	void SetLayerOffset(int iLayer, int iOffsetX, int iOffsetY);
+	void SetLayerBlendMode(int iLayer, int iBlendMode);
+
+	//set one Led of a layer to a specific state (the coordinates are relative to the top left corner of the layer)
+	void SetLayerLed(int iLayer, int iCoordX, int iCoordY, bool bState);
+
+	//set every LED of a layer either to be enabled or disabled
+	void ClearLayer(int iLayer, bool bState = false);
+
+	//tell the library, that the buffer of a layer was changed directly
+	void LayerChanged(int iLayer);
+
+	/*
+	the layers are not copied into m_LedState, they are combined with it while the changed LED rows are sent in "UpdateMatrix"
+	--> changing a layer doesn't require to redraw anything below it
+	layer 0 is combined first, so the layers with higher numbers are on top of it
+
+	e.g. a clock on top of an animation
+	char ClockStates[4 * 8]; //32 x 8 LEDs
+	lm.SetLayer(0, ClockStates, 4, 8);
+	lm.SetLayerOffset(0, 0, 16);
+	*/
 
 
 	//update the matrix
-	void UpdateMatrix();
+	//only the LED rows, which were changed since the last update, are sent
+	//pass true to send every LED row (e.g. to recover the controllers after a brown-out or noise on the lines)
+	void UpdateMatrix(bool bSendAll = false);
 };
 
 
@@ -0,0 +1,145 @@
+//include the header file
+#include "LedMatrixBus.h"
+
+//the class constructor
+LedMatrixBus::LedMatrixBus(int iDataPin, int iClkPin)
+{
+	m_iDataPin = iDataPin;
+	m_iClkPin = iClkPin;
+
+	//there aren't any chains yet
+	m_iNumChains = 0;
+
+	//set the pinmodes of the pins selected as outputs
+	pinMode(iDataPin, OUTPUT);
+	pinMode(iClkPin, OUTPUT);
+}
+
+//the class destructor
+LedMatrixBus::~LedMatrixBus()
+{
+	//the chains mustn't unregister themselves from this bus anymore
+	for (int i = 0; i < m_iNumChains; i++)
+		m_Chains[i]->m_pBus = 0;
+}
+
+
+
+//private functions
+//register a chain
+bool LedMatrixBus::AddMatrix(LedMatrix* pMatrix)
+{
+	//there isn't any space left for the chain
+	if (m_iNumChains >= LED_MATRIX_BUS_MAX_CHAINS)
+		return false;
+
+	m_Chains[m_iNumChains++] = pMatrix;
+	return true;
+}
+
+//unregister a chain
+void LedMatrixBus::RemoveMatrix(LedMatrix* pMatrix)
+{
+	for (int i = 0; i < m_iNumChains; i++)
+	{
+		if (m_Chains[i] != pMatrix)
+			continue;
+
+		//move the following chains forward, so there aren't any gaps
+		for (int j = i + 1; j < m_iNumChains; j++)
+			m_Chains[j - 1] = m_Chains[j];
+		m_iNumChains--;
+		return;
+	}
+}
+
+//send a command to every matrix of every chain at once
+void LedMatrixBus::SendToAll(int iCommandID, int iData)
+{
+	if (m_iNumChains == 0)
+		return;
+
+	//set the CS pin of every chain to low, so all of them receive the same data
+	int iMaxMatrices = 0;
+	for (int i = 0; i < m_iNumChains; i++)
+	{
+		*m_Chains[i]->m_pCSPinReg &= NotTwoToThe[m_Chains[i]->m_iCSPinNum];
+		iMaxMatrices = max(iMaxMatrices, m_Chains[i]->m_iNumMatrices);
+	}
+
+	/*send the command once for each matrix of the longest chain
+	(the shorter chains just shift the first commands out, but every command is the same anyway)*/
+	for (int i = 0; i < iMaxMatrices; i++)
+		m_Chains[0]->SendData(iCommandID, iData);
+
+	//set the CS pins to high, so the data get latched into the registers of the controllers
+	for (int i = 0; i < m_iNumChains; i++)
+		*m_Chains[i]->m_pCSPinReg |= TwoToThe[m_Chains[i]->m_iCSPinNum];
+}
+
+
+
+//public functions
+//initialize the matrices of every chain
+void LedMatrixBus::Begin(int iLEDIntensity)
+{
+	//disable display test mode
+	SendToAll(15, 0);
+	//go out of shutdown mode
+	SendToAll(12, 1);
+	//set the scan limit to the maximum, so every digit is displayed
+	SendToAll(11, 7);
+	//turn off any decoding
+	SendToAll(9, 0);
+	//set the intensity to the value which was passed to this function
+	SendToAll(10, iLEDIntensity);
+}
+
+//set the intensity of every matrix of every chain
+void LedMatrixBus::SetIntensities(int iIntensity)
+{
+	SendToAll(10, iIntensity);
+}
+
+//send the changed LED rows of every chain
+void LedMatrixBus::FlushAll(bool bSendAll)
+{
+	if (m_iNumChains == 0)
+		return;
+
+	//the data and clock pins are the same for every chain, so get their values only once
+	int iMOSIPin = TwoToThe[m_Chains[0]->m_iMOSIPinNum];
+	int iNotMOSIPin = NotTwoToThe[m_Chains[0]->m_iMOSIPinNum];
+	int iCLKPin = TwoToThe[m_Chains[0]->m_iCLKPinNum];
+	int iNotCLKPin = NotTwoToThe[m_Chains[0]->m_iCLKPinNum];
+
+	//check once per chain, if its layers have to be combined
+	bool bBlendLayers[LED_MATRIX_BUS_MAX_CHAINS];
+	for (int i = 0; i < m_iNumChains; i++)
+		bBlendLayers[i] = m_Chains[i]->HasVisibleLayers();
+
+	//send every LED row of every chain again, if the caller asks for it
+	if (bSendAll)
+	{
+		for (int i = 0; i < m_iNumChains; i++)
+			m_Chains[i]->m_iDirtyRows = 0b11111111;
+	}
+
+	//repeat for each row, so the rows of the chains are sent one after another
+	for (int i = 0; i < 8; i++)
+	{
+		//only send the chains, in which this row changed
+		for (int j = 0; j < m_iNumChains; j++)
+		{
+			if (m_Chains[j]->m_iDirtyRows & TwoToThe[i])
+				m_Chains[j]->SendRow(&iMOSIPin, &iNotMOSIPin, &iCLKPin, &iNotCLKPin, i, bBlendLayers[j]);
+		}
+	}
+
+	//every LED row of every chain is up to date now
+	for (int i = 0; i < m_iNumChains; i++)
+	{
+		m_Chains[i]->m_iDirtyRows = 0;
+		m_Chains[i]->m_bClipStatesValid = false;
+	}
+}
@@ -0,0 +1,91 @@
+//make sure the code is executed only once
+#ifndef LED_MATRIX_BUS_H
+#define LED_MATRIX_BUS_H
+
+//include the LedMatrix library, which sends the data of each chain
+#include "LedMatrix.h"
+
+
+
+//constants
+//the maximum number of chains on one bus (the chains, which don't fit anymore, are updated on their own)
+const int LED_MATRIX_BUS_MAX_CHAINS	= 4;
+
+
+
+//the LedMatrixBus class
+class LedMatrixBus
+{
+private: //private class members
+
+	//the chains need to know the shared pins
+	friend class LedMatrix;
+
+	//the shared pins
+	int m_iDataPin;
+	int m_iClkPin;
+
+	//the chains of matrices, which are connected to the bus
+	LedMatrix* m_Chains[LED_MATRIX_BUS_MAX_CHAINS];
+	int m_iNumChains;
+
+
+	//register a chain (called by the LedMatrix constructor, returns false if there are already LED_MATRIX_BUS_MAX_CHAINS chains)
+	bool AddMatrix(LedMatrix* pMatrix);
+
+	//unregister a chain (called by the LedMatrix destructor)
+	void RemoveMatrix(LedMatrix* pMatrix);
+
+	//send a command to every matrix of every chain at once
+	void SendToAll(int iCommandID, int iData);
+
+	//a bus can't be copied, because the chains store its address
+	LedMatrixBus(const LedMatrixBus&);
+	LedMatrixBus& operator=(const LedMatrixBus&);
+
+
+public: //public class members
+
+	//constructor
+	LedMatrixBus(int iDataPin, //the ID of the pin, which is connected to "DIN" on each chain of MAX7221
+		int iClkPin); //the ID of the pin, which is connected to "CLK" on each chain of MAX7221
+
+	//the chains, which are still connected, have to send their data on their own afterwards
+	~LedMatrixBus();
+
+	/*
+	several chains of matrices can share the data and the clock pin, only the CS pin has to be different for each chain
+
+	e.g.
+	LedMatrixBus bus(12, 11);
+	LedMatrix lm1(&bus, 10, mc1, md1, 4, 1);
+	LedMatrix lm2(&bus, 9, mc2, md2, 4, 2);
+
+	void setup()
+	{
+		bus.Begin(8);
+	}
+
+	void loop()
+	{
+		lm1.SetLed(...);
+		lm2.DrawLine(...);
+		bus.FlushAll(); //sends only the changed LED rows of both chains
+	}
+	*/
+
+
+	//initialize the matrices of every chain (all chains get the commands at the same time)
+	void Begin(int iLEDIntensity = 8);
+
+	//set the intensity of every matrix of every chain
+	//iIntensity can range from 0 (least bright) to 15 (brightest)
+	void SetIntensities(int iIntensity);
+
+	//send the changed LED rows of every chain (instead of calling "UpdateMatrix" for each chain)
+	//pass true to send every LED row of every chain (like "UpdateMatrix(true)")
+	void FlushAll(bool bSendAll = false);
+};
+
+
+#endif //LED_MATRIX_BUS_H